@@ -3,13 +3,20 @@
 #include "cinder/gl/gl.h"
 #include "cinder/params/Params.h" // Cinderڵ֧
 #include "DMXPro.hpp"
+#include "GestureColorMap.h"
+
+#include <map>
 
 using namespace ci;
 using namespace ci::app;
 
 class BasicApp : public App {
 public:
+    void mouseDown(MouseEvent event) override;
     void mouseDrag(MouseEvent event) override;
+    void touchesBegan(TouchEvent event) override;
+    void touchesMoved(TouchEvent event) override;
+    void touchesEnded(TouchEvent event) override;
     void keyDown(KeyEvent event) override;                                                                   
     void draw() override;
     void update() override;
@@ -25,6 +32,25 @@ private:
     float mTiltOffset = 0.0f; //  Tilt ƫ
     int startAddress = 360;
     Color mCurrentColor = Color(1.0f, 1.0f, 1.0f); // Default white color
+    GestureColorMap mGestureColors;
+    float mGestureSmoothing = 0.5f;
+    vec2 mLastDragPos;
+    double mLastDragTime = 0.0;
+
+    // Smoothed velocity of each touch on the right half, keyed by touch id
+    struct TouchState {
+        vec2 mPos;
+        vec2 mVelocity;
+        double mTime;
+    };
+    std::map<uint32_t, TouchState> mTouches;
+    std::vector<uint32_t> mTouchIds;
+    std::vector<vec2> mTouchPositions;
+    std::vector<vec2> mTouchVelocities;
+    std::vector<Rgbw> mTouchColors;
+
+    void setLightDirection(const vec2& pos);
+    void setLightRgbw(const Rgbw& rgbw);
 
     // 
     params::InterfaceGlRef mParams;
@@ -32,80 +58,138 @@ private:
 
 void prepareSettings(BasicApp::Settings* settings)
 {
-    settings->setMultiTouchEnabled(false);
+    settings->setMultiTouchEnabled(true);
+}
+
+void BasicApp::mouseDown(MouseEvent event)
+{
+    // Each stroke starts at rest so the idle time before it does not count
+    mLastDragPos = event.getPos();
+    mLastDragTime = getElapsedSeconds();
+    mGestureColors.reset();
 }
 
 void BasicApp::mouseDrag(MouseEvent event)
 {
     vec2 currentPos = event.getPos();
-    float windowWidth = getWindowWidth();
-    float windowHeight = getWindowHeight();
+    double now = getElapsedSeconds();
 
-    if (currentPos.x < windowWidth / 2) {
+    if (currentPos.x < getWindowWidth() / 2) {
         // Left half: Control direction (Pan and Tilt)
-        float normalizedX = static_cast<float>(currentPos.x) / (windowWidth / 2);
-        float normalizedY = static_cast<float>(currentPos.y) / windowHeight;
+        setLightDirection(currentPos);
+    }
+    else {
+        // Right half: Control color based on line angle and speed
+        vec2 direction = currentPos - mLastDragPos;
+        direction.y = -direction.y;
+        setLightRgbw(mGestureColors.update(direction, static_cast<float>(now - mLastDragTime)));
 
-        mPan = normalizedX * 128.0f;
-        mTilt = normalizedY * 128.0f;
+        mPointsRight.push_back(currentPos);
+    }
 
-        if (mDmxDevice) {
-            mDmxDevice->setValue(static_cast<int>(mPan), startAddress + 0); // Pan
-            mDmxDevice->setValue(static_cast<int>(mTilt), startAddress + 2); // Tilt
+    mLastDragPos = currentPos;
+    mLastDragTime = now;
+}
+
+void BasicApp::touchesBegan(TouchEvent event)
+{
+    double now = getElapsedSeconds();
+    for (const TouchEvent::Touch& touch : event.getTouches()) {
+        mTouches[touch.getId()] = { touch.getPos(), vec2(0.0f), now };
+    }
+}
+
+void BasicApp::touchesMoved(TouchEvent event)
+{
+    // Left-half touches steer the light like a mouse drag. Right-half touches
+    // are smoothed per touch, then looked up in one batch. The fixture shows
+    // the fastest touch, so distinct hues are not averaged into a wash, and
+    // every touch is drawn in its own color.
+    double now = getElapsedSeconds();
+    mTouchIds.clear();
+    mTouchPositions.clear();
+    mTouchVelocities.clear();
+
+    for (const TouchEvent::Touch& touch : event.getTouches()) {
+        vec2 pos = touch.getPos();
+        TouchState& state = mTouches.emplace(touch.getId(), TouchState{ pos, vec2(0.0f), now }).first->second;
+
+        if (pos.x < getWindowWidth() / 2) {
+            setLightDirection(pos);
         }
+        else {
+            vec2 delta = pos - state.mPos;
+            float dt = std::max(static_cast<float>(now - state.mTime), 1e-3f);
+            state.mVelocity = mGestureColors.smooth(state.mVelocity, vec2(delta.x, -delta.y) / dt);
 
-        mPointsLeft.push_back(currentPos);
+            mTouchIds.push_back(touch.getId());
+            mTouchPositions.push_back(pos);
+            mTouchVelocities.push_back(state.mVelocity);
+        }
+        state.mPos = pos;
+        state.mTime = now;
     }
-    else {
-        // Right half: Control color based on line angle
-        if (!mPointsRight.empty()) {
-            vec2 lastPoint = mPointsRight.back();
-            vec2 direction = currentPos - lastPoint;
-            float angle = glm::degrees(atan2(-direction.y, direction.x));
-
-            if (angle < 0) {
-                angle += 360.0f;
-            }
-
-            if (angle >= 0.0f && angle < 90.0f) {
-                mCurrentColor = Color(1.0f, 1.0f, 1.0f); // White
-                if (mDmxDevice) {
-                    mDmxDevice->setValue(0, startAddress + 7);
-                    mDmxDevice->setValue(0, startAddress + 8);
-                    mDmxDevice->setValue(0, startAddress + 9);
-                    mDmxDevice->setValue(70, startAddress + 10);
-                }
-            }
-            else if (angle >= 90.0f && angle < 180.0f) {
-                mCurrentColor = Color(0.0f, 0.0f, 1.0f); // Blue
-                if (mDmxDevice) {
-                    mDmxDevice->setValue(0, startAddress + 7);
-                    mDmxDevice->setValue(0, startAddress + 8);
-                    mDmxDevice->setValue(70, startAddress + 9);
-                    mDmxDevice->setValue(0, startAddress + 10);
-                }
-            }
-            else if (angle >= 180.0f && angle < 270.0f) {
-                mCurrentColor = Color(1.0f, 0.0f, 0.0f); // Red
-                if (mDmxDevice) {
-                    mDmxDevice->setValue(70, startAddress + 7);
-                    mDmxDevice->setValue(0, startAddress + 8);
-                    mDmxDevice->setValue(0, startAddress + 9);
-                    mDmxDevice->setValue(0, startAddress + 10);
-                }
-            }
-            else if (angle >= 270.0f && angle < 360.0f) {
-                mCurrentColor = Color(0.0f, 1.0f, 0.0f); // Green
-                if (mDmxDevice) {
-                    mDmxDevice->setValue(0, startAddress + 7);
-                    mDmxDevice->setValue(255, startAddress + 8);
-                    mDmxDevice->setValue(0, startAddress + 9);
-                    mDmxDevice->setValue(0, startAddress + 10);
-                }
-            }
+
+    mTouchColors.resize(mTouchVelocities.size());
+    if (mTouchVelocities.empty()) {
+        return;
+    }
+    mGestureColors.lookup(mTouchVelocities.data(), mTouchVelocities.size(), mTouchColors.data());
+
+    size_t fastest = 0;
+    for (size_t i = 1; i < mTouchVelocities.size(); ++i) {
+        if (dot(mTouchVelocities[i], mTouchVelocities[i]) > dot(mTouchVelocities[fastest], mTouchVelocities[fastest])) {
+            fastest = i;
         }
+    }
+    setLightRgbw(mTouchColors[fastest]);
+}
 
-        mPointsRight.push_back(currentPos);
+void BasicApp::touchesEnded(TouchEvent event)
+{
+    // Lifted touches stop being drawn right away, not on the next move
+    for (const TouchEvent::Touch& touch : event.getTouches()) {
+        mTouches.erase(touch.getId());
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < mTouchIds.size() && i < mTouchColors.size(); ++i) {
+        if (mTouches.count(mTouchIds[i]) != 0) {
+            mTouchIds[count] = mTouchIds[i];
+            mTouchPositions[count] = mTouchPositions[i];
+            mTouchColors[count] = mTouchColors[i];
+            ++count;
+        }
+    }
+    mTouchIds.resize(count);
+    mTouchPositions.resize(count);
+    mTouchColors.resize(count);
+}
+
+void BasicApp::setLightDirection(const vec2& pos)
+{
+    float normalizedX = static_cast<float>(pos.x) / (getWindowWidth() / 2);
+    float normalizedY = static_cast<float>(pos.y) / getWindowHeight();
+
+    mPan = normalizedX * 128.0f;
+    mTilt = normalizedY * 128.0f;
+
+    if (mDmxDevice) {
+        mDmxDevice->setValue(static_cast<int>(mPan), startAddress + 0); // Pan
+        mDmxDevice->setValue(static_cast<int>(mTilt), startAddress + 2); // Tilt
+    }
+
+    mPointsLeft.push_back(pos);
+}
+
+void BasicApp::setLightRgbw(const Rgbw& rgbw)
+{
+    mCurrentColor = mGestureColors.toColor(rgbw);
+    if (mDmxDevice) {
+        const FixtureProfile& profile = mGestureColors.getProfile();
+        mDmxDevice->setValue(rgbw.r, startAddress + profile.mRed);
+        mDmxDevice->setValue(rgbw.g, startAddress + profile.mGreen);
+        mDmxDevice->setValue(rgbw.b, startAddress + profile.mBlue);
+        mDmxDevice->setValue(rgbw.w, startAddress + profile.mWhite);
     }
 }
 
@@ -117,6 +201,7 @@ void BasicApp::keyDown(KeyEvent event)
     else if (event.getCode() == KeyEvent::KEY_SPACE) {
         mPointsLeft.clear();
         mPointsRight.clear();
+        mGestureColors.reset();
     }
     else if (event.getCode() == KeyEvent::KEY_ESCAPE) {
         if (isFullScreen())
@@ -150,6 +235,11 @@ void BasicApp::setup() {
             mDmxDevice->setValue(static_cast<int>(mTilt), startAddress + 2);
         }
         });
+
+    mGestureColors.setSmoothing(mGestureSmoothing);
+    mParams->addParam("Color Smoothing", &mGestureSmoothing).min(0.0f).max(0.95f).step(0.05f).updateFn([this]() {
+        mGestureColors.setSmoothing(mGestureSmoothing);
+        });
 }
 
 
@@ -181,6 +271,12 @@ void BasicApp::draw() {
     }
     gl::end();
 
+    // Current touches on the right half, each in its own color
+    for (size_t i = 0; i < mTouchPositions.size() && i < mTouchColors.size(); ++i) {
+        gl::color(mGestureColors.toColor(mTouchColors[i]));
+        gl::drawSolidCircle(mTouchPositions[i], 20.0f);
+    }
+
     mParams->draw(); // Ʋ
 }
 
@@ -4,6 +4,12 @@
 #include "cinder/params/Params.h"
 #include "DMXPro.hpp"
 #include "WebSocketServer.h"
+#include "PriorityLane.h"
+#include "CueScript.h"
+#include "CsvDataset.h"
+#include <cmath>
+#include <future>
+#include <thread>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -12,6 +18,9 @@ using namespace ci;
 using namespace ci::app;
 using namespace std;
 
+// Shortest time a data sweep spends on one row
+static const double kMinDataStepMs = 10.0;
+
 class CinderProjectApp : public App {
 public:
     void setup() override;
@@ -30,9 +39,44 @@ private:
     params::InterfaceGlRef mParams;
     shared_ptr<WebSocketServer> mWebSocketServer;
 
+    // Safety commands bypass the bulk traffic below
+    PriorityLane mPriorityLane;
+    float mSafetyLastLatencyMs = 0.0f;
+    float mSafetyWorstLatencyMs = 0.0f;
+
+    // Bulk traffic is coalesced per tick: only the latest value is applied
+    bool mHasPendingDirection = false;
+    float mPendingPan = 0.0f;
+    float mPendingTilt = 0.0f;
+    string mPendingColor;
+
+    // Server-side cue scripts, resumed once per tick. Cue time does not
+    // advance while the priority lane is locked, so cues resume where they were
+    CueScheduler mCueScheduler;
+    double mCueTime = 0.0;
+    double mLastUpdateTime = 0.0;
+
+    // Dataset columns driving the fixture during a data sweep. Fixed ranges
+    // keep the mapping stable across the windows of a large file.
+    vector<CsvBinding> mDataBindings = {
+        { "internet user per 100", FixtureParam::Brightness, 0.0f, 100.0f },
+        { "birth rate per 1000", FixtureParam::Hue, 5.0f, 50.0f }
+    };
+
     void setLightColor(const string& color);
+    void setLightColor(const Color& color);
+    void setLightDirection(float pan, float tilt);
     void updateLightDirection(float pan, float tilt);
     void processWebSocketMessage(const string& msg);
+    void applySafetyCommand(PriorityLane::Command cmd);
+    void applyPendingSafetyCommand();
+    void flushPendingCommands();
+    void startCue(const string& name);
+
+    Cue sweepCue();
+    Cue pulseCue();
+    Cue fadeToColorCue(Color target, double ms);
+    Cue dataSweepCue(string path, double stepMs);
 };
 
 void CinderProjectApp::setup() {
@@ -57,6 +101,9 @@ void CinderProjectApp::setup() {
     mParams = params::InterfaceGl::create("Light Control", ivec2(250, 200));
     mParams->addParam("Pan", &mPan).min(0.0f).max(255.0f).step(1.0f);
     mParams->addParam("Tilt", &mTilt).min(0.0f).max(255.0f).step(1.0f);
+    mParams->addSeparator();
+    mParams->addParam("Safety last (ms)", &mSafetyLastLatencyMs, true);
+    mParams->addParam("Safety worst (ms)", &mSafetyWorstLatencyMs, true);
 
     // WebSocket Server Setup
     mWebSocketServer = make_shared<WebSocketServer>();
@@ -65,14 +112,34 @@ void CinderProjectApp::setup() {
 
     // Handle WebSocket messages
     mWebSocketServer->connectMessageEventHandler([this](const string& msg) {
-        console() << "Received WebSocket message: " << msg << endl;
+        // Safety commands are latched before anything else touches the message
+        PriorityLane::Command cmd = PriorityLane::classify(msg);
+        if (cmd != PriorityLane::Command::None) {
+            mPriorityLane.trigger(cmd);
+            return;
+        }
+        if (mPriorityLane.isLocked()) {
+            return;
+        }
+
         processWebSocketMessage(msg);
         });
 
+    mCueScheduler.connectFailEventHandler([](const string& err) {
+        console() << "Cue failed: " << err << endl;
+        });
+
+    // Time the first safety command from here, not from construction
+    mPriorityLane.markDrained();
+
     console() << "Setup complete." << endl;
 }
 
 void CinderProjectApp::mouseDrag(MouseEvent event) {
+    if (mPriorityLane.isLocked()) {
+        return;
+    }
+
     vec2 currentPos = event.getPos();
     mPointsWithTime.push_back(make_pair(currentPos, getElapsedSeconds()));
 
@@ -99,7 +166,28 @@ void CinderProjectApp::keyDown(KeyEvent event) {
 
 void CinderProjectApp::update() {
     if (mWebSocketServer) {
-        mWebSocketServer->poll();
+        // Handle one message at a time so a safety command is applied as soon
+        // as it is seen; bulk messages queued behind it are then dropped
+        while (mWebSocketServer->pollOne() > 0) {
+            applyPendingSafetyCommand();
+        }
+    }
+    mPriorityLane.markDrained();
+    applyPendingSafetyCommand();
+
+    double now = getElapsedSeconds();
+    double elapsed = now - mLastUpdateTime;
+    mLastUpdateTime = now;
+
+    if (mPriorityLane.isLocked()) {
+        // Drop anything that was coalesced before the lock was taken
+        mHasPendingDirection = false;
+        mPendingColor.clear();
+    }
+    else {
+        flushPendingCommands();
+        mCueTime += elapsed;
+        mCueScheduler.tick(mCueTime);
     }
 }
 
@@ -153,11 +241,20 @@ void CinderProjectApp::setLightColor(const string& color) {
     }
 }
 
+// Sets the DMX light color from RGB values
+void CinderProjectApp::setLightColor(const Color& color) {
+    mCurrentColor = color;
+
+    if (mDmxDevice) {
+        mDmxDevice->setValue(static_cast<int>(glm::clamp(color.r, 0.0f, 1.0f) * 255.0f), startAddress + 7);
+        mDmxDevice->setValue(static_cast<int>(glm::clamp(color.g, 0.0f, 1.0f) * 255.0f), startAddress + 8);
+        mDmxDevice->setValue(static_cast<int>(glm::clamp(color.b, 0.0f, 1.0f) * 255.0f), startAddress + 9);
+        mDmxDevice->setValue(0, startAddress + 10);
+    }
+}
 
 // Handles WebSocket messages
 void CinderProjectApp::processWebSocketMessage(const string& msg) {
-    console() << "Processing WebSocket message: " << msg << endl;
-
     if (msg.find("\"type\":\"color_change\"") != string::npos) {
         size_t startPos = msg.find("\"color\":\"");
         if (startPos != string::npos) {
@@ -165,11 +262,72 @@ void CinderProjectApp::processWebSocketMessage(const string& msg) {
             size_t endPos = msg.find("\"", startPos);
             if (endPos != string::npos) {
                 string color = msg.substr(startPos, endPos - startPos);
-                console() << "Extracted Color: " << color << endl;
-                setLightColor(color);
+                mPendingColor = color;
+                return;
+            }
+        }
+    }
+    else if (msg.find("\"type\":\"cue\"") != string::npos) {
+        size_t startPos = msg.find("\"name\":\"");
+        if (startPos != string::npos) {
+            startPos += 8;
+            size_t endPos = msg.find("\"", startPos);
+            if (endPos != string::npos) {
+                startCue(msg.substr(startPos, endPos - startPos));
+                return;
+            }
+        }
+    }
+    else if (msg.find("\"type\":\"data_sweep\"") != string::npos) {
+        string file = "data.csv";
+        double stepMs = 250.0;
+
+        size_t filePos = msg.find("\"file\":\"");
+        if (filePos != string::npos) {
+            filePos += 8;
+            size_t endPos = msg.find("\"", filePos);
+            if (endPos != string::npos) {
+                file = msg.substr(filePos, endPos - filePos);
+            }
+        }
+        size_t stepPos = msg.find("\"step\":");
+        if (stepPos != string::npos) {
+            try {
+                stepMs = stod(msg.substr(stepPos + 7));
+            }
+            catch (...) {
+                stepMs = NAN;
+            }
+            if (!isfinite(stepMs)) {
+                console() << "Data sweep rejected, invalid step: " << msg << endl;
                 return;
             }
+            stepMs = max(stepMs, kMinDataStepMs);
         }
+
+        // Only plain .csv file names from the assets directory, or failing
+        // that the app directory where data.csv ships, can be swept
+        fs::path name(file);
+        fs::path path;
+        if (name.filename() == name && name.extension() == ".csv") {
+            path = getAssetPath(name);
+            if (path.empty() && fs::exists(getAppPath() / name)) {
+                path = getAppPath() / name;
+            }
+        }
+        if (path.empty()) {
+            console() << "Data sweep rejected, no such dataset: " << file << endl;
+            return;
+        }
+
+        mCueScheduler.start(dataSweepCue(path.string(), stepMs));
+        console() << "Data sweep started: " << file << " (" << stepMs << " ms per row)" << endl;
+        return;
+    }
+    else if (msg.find("\"type\":\"cue_stop\"") != string::npos) {
+        mCueScheduler.stopAll();
+        console() << "All cues stopped" << endl;
+        return;
     }
     else if (msg.find("\"type\":\"light_control\"") != string::npos) {
         size_t panPos = msg.find("\"pan\":");
@@ -182,8 +340,9 @@ void CinderProjectApp::processWebSocketMessage(const string& msg) {
             float pan = stof(msg.substr(panPos, msg.find(",", panPos) - panPos));
             float tilt = stof(msg.substr(tiltPos, msg.find("}", tiltPos) - tiltPos));
 
-            console() << "Parsed Pan: " << pan << ", Tilt: " << tilt << endl;
-            updateLightDirection(pan, tilt);
+            mPendingPan = pan;
+            mPendingTilt = tilt;
+            mHasPendingDirection = true;
             return;
         }
     }
@@ -192,8 +351,8 @@ void CinderProjectApp::processWebSocketMessage(const string& msg) {
 }
 
 
-// Updates light direction based on WebSocket data
-void CinderProjectApp::updateLightDirection(float pan, float tilt) {
+// Sets the DMX light direction without logging, for per-tick callers such as cues
+void CinderProjectApp::setLightDirection(float pan, float tilt) {
     mPan = pan;
     mTilt = tilt;
 
@@ -201,8 +360,241 @@ void CinderProjectApp::updateLightDirection(float pan, float tilt) {
         mDmxDevice->setValue(static_cast<int>(mPan), startAddress);
         mDmxDevice->setValue(static_cast<int>(mTilt), startAddress + 2);
     }
+}
+
+// Updates light direction based on WebSocket data
+void CinderProjectApp::updateLightDirection(float pan, float tilt) {
+    setLightDirection(pan, tilt);
 
     console() << "Updated light direction: Pan=" << mPan << ", Tilt=" << mTilt << endl;
 }
 
+// Applies a safety command directly to the fixture, bypassing the coalesced state
+void CinderProjectApp::applySafetyCommand(PriorityLane::Command cmd) {
+    if (cmd == PriorityLane::Command::Blackout) {
+        mCurrentColor = Color(0.0f, 0.0f, 0.0f);
+        if (mDmxDevice) {
+            mDmxDevice->setValue(0, startAddress + 7);
+            mDmxDevice->setValue(0, startAddress + 8);
+            mDmxDevice->setValue(0, startAddress + 9);
+            mDmxDevice->setValue(0, startAddress + 10);
+        }
+    }
+    else if (cmd == PriorityLane::Command::Emergency) {
+        // Full white, pointed back to the home position
+        mPan = 127.0f;
+        mTilt = 127.0f;
+        mCurrentColor = Color(1.0f, 1.0f, 1.0f);
+        if (mDmxDevice) {
+            mDmxDevice->setValue(static_cast<int>(mPan), startAddress);
+            mDmxDevice->setValue(static_cast<int>(mTilt), startAddress + 2);
+            mDmxDevice->setValue(0, startAddress + 7);
+            mDmxDevice->setValue(0, startAddress + 8);
+            mDmxDevice->setValue(0, startAddress + 9);
+            mDmxDevice->setValue(255, startAddress + 10);
+        }
+    }
+
+    console() << "Safety command applied after " << mPriorityLane.getLastLatencyMs()
+        << " ms (worst " << mPriorityLane.getWorstLatencyMs() << " ms)" << endl;
+}
+
+// Applies a latched safety command, if any, and updates the latency readout
+void CinderProjectApp::applyPendingSafetyCommand() {
+    PriorityLane::Command cmd = mPriorityLane.take();
+    if (cmd != PriorityLane::Command::None) {
+        applySafetyCommand(cmd);
+        mSafetyLastLatencyMs = static_cast<float>(mPriorityLane.getLastLatencyMs());
+        mSafetyWorstLatencyMs = static_cast<float>(mPriorityLane.getWorstLatencyMs());
+    }
+}
+
+// Applies the latest coalesced bulk commands once per tick
+void CinderProjectApp::flushPendingCommands() {
+    if (mHasPendingDirection) {
+        updateLightDirection(mPendingPan, mPendingTilt);
+        mHasPendingDirection = false;
+    }
+    if (!mPendingColor.empty()) {
+        setLightColor(mPendingColor);
+        mPendingColor.clear();
+    }
+}
+
+// Starts a built-in cue script by name
+void CinderProjectApp::startCue(const string& name) {
+    if (name == "sweep") {
+        mCueScheduler.start(sweepCue());
+    }
+    else if (name == "pulse") {
+        mCueScheduler.start(pulseCue());
+    }
+    else if (name == "red" || name == "green" || name == "blue") {
+        Color target(name == "red" ? 1.0f : 0.0f, name == "green" ? 1.0f : 0.0f, name == "blue" ? 1.0f : 0.0f);
+        mCueScheduler.start(fadeToColorCue(target, 1500.0));
+    }
+    else {
+        console() << "Unknown cue: " << name << endl;
+        return;
+    }
+    console() << "Cue started: " << name << " (" << mCueScheduler.getNumActive() << " active)" << endl;
+}
+
+// Pans across the full range and back to center
+Cue CinderProjectApp::sweepCue() {
+    auto pan = [this](float value) { setLightDirection(value, mTilt); };
+    co_await cue::fade(mPan, 0.0f, 1000.0, pan);
+    co_await cue::fade(0.0f, 255.0f, 4000.0, pan);
+    co_await cue::wait(500.0);
+    co_await cue::fade(255.0f, 127.0f, 2000.0, pan);
+}
+
+// Alternates red and blue on every beat for four bars
+Cue CinderProjectApp::pulseCue() {
+    for (int i = 0; i < 16; ++i) {
+        co_await cue::beat();
+        setLightColor(i % 2 == 0 ? Color(1.0f, 0.0f, 0.0f) : Color(0.0f, 0.0f, 1.0f));
+    }
+}
+
+// Cross-fades from the current color to the target color
+Cue CinderProjectApp::fadeToColorCue(Color target, double ms) {
+    Color from = mCurrentColor;
+    co_await cue::fade(0.0f, 1.0f, ms, [this, from, target](float t) {
+        setLightColor(from.lerp(t, target));
+        });
+}
+
+// Runs fn on a detached thread. Unlike std::async, dropping the returned
+// future does not wait for fn, so stopping a cue never blocks the tick.
+template<typename Fn>
+static future<bool> runDetached(Fn fn) {
+    shared_ptr<promise<bool>> result = make_shared<promise<bool>>();
+    future<bool> done = result->get_future();
+    thread([result, fn]() mutable {
+        try {
+            result->set_value(fn());
+        }
+        catch (...) {
+            result->set_exception(current_exception());
+        }
+        }).detach();
+    return done;
+}
+
+// Stream and read-ahead buffer of a data sweep, shared with its loader thread
+struct DataSweepState {
+    CsvStream mStream;
+    CsvChunk mAhead;
+    vector<CsvBinding> mBindings;
+    string mError;
+};
+
+// Sweeps through a dataset row by row, driving the fixture from the bound
+// columns. Every window, including the first, is mapped and parsed in the
+// background while the cue keeps yielding to the tick. Only the bound columns
+// are parsed, so memory holds the chunk being played plus the one being
+// loaded, which briefly doubles while its threads' results are merged: about
+// three windows' rows times 4 bytes per bound column, on top of the mapping.
+Cue CinderProjectApp::dataSweepCue(string path, double stepMs) {
+    stepMs = max(stepMs, kMinDataStepMs);
+
+    shared_ptr<DataSweepState> state = make_shared<DataSweepState>();
+    DataSweepState* loader = state.get();
+    state->mStream.connectFailEventHandler([loader](const string& err) {
+        loader->mError = err;
+        });
+
+    state->mBindings = mDataBindings;
+
+    future<bool> loading = runDetached([state, path]() {
+        CsvStream& stream = state->mStream;
+        if (!stream.open(path)) {
+            return false;
+        }
+
+        vector<int32_t> columns;
+        for (CsvBinding& binding : state->mBindings) {
+            binding.mIndex = stream.findColumn(binding.mColumn);
+            if (binding.mIndex >= 0 && stream.isTextColumn(binding.mIndex)) {
+                binding.mIndex = -1;
+            }
+            if (binding.mIndex >= 0) {
+                columns.push_back(binding.mIndex);
+            }
+        }
+        if (columns.empty()) {
+            state->mError = "no numeric column is bound";
+            return false;
+        }
+        stream.selectColumns(columns);
+        return stream.next(state->mAhead);
+        });
+
+    const vector<CsvBinding>& bindings = state->mBindings;
+    CsvChunk chunk;
+    bool hasChunk = true;
+    bool isFirst = true;
+    while (hasChunk) {
+        while (loading.wait_for(chrono::seconds(0)) != future_status::ready) {
+            co_await cue::nextTick();
+        }
+        hasChunk = loading.get();
+        if (!state->mError.empty()) {
+            console() << "Data sweep failed: " << state->mError << endl;
+            state->mError.clear();
+        }
+        if (!hasChunk) {
+            break;
+        }
+
+        if (isFirst) {
+            for (const CsvBinding& binding : bindings) {
+                if (binding.mIndex < 0) {
+                    console() << "Data sweep: no numeric column \"" << binding.mColumn << "\"" << endl;
+                }
+            }
+            isFirst = false;
+        }
+
+        swap(chunk, state->mAhead);
+        loading = runDetached([state]() { return state->mStream.next(state->mAhead); });
+
+        vector<pair<float, float>> ranges;
+        for (const CsvBinding& binding : bindings) {
+            ranges.push_back(binding.mIndex >= 0 ? chunk.getRange(binding.mIndex) : make_pair(0.0f, 0.0f));
+        }
+
+        for (size_t row = 0; row < chunk.getNumRows(); ++row) {
+            float hue = 0.0f;
+            float saturation = 1.0f;
+            float brightness = 1.0f;
+            float pan = mPan;
+            float tilt = mTilt;
+            bool hasDirection = false;
+
+            for (size_t i = 0; i < bindings.size(); ++i) {
+                const CsvBinding& binding = bindings[i];
+                if (binding.mIndex < 0) {
+                    continue;
+                }
+                float value = binding.normalize(chunk.getValues(binding.mIndex)[row], ranges[i]);
+                switch (binding.mParam) {
+                case FixtureParam::Brightness: brightness = value; break;
+                case FixtureParam::Hue: hue = value; break;
+                case FixtureParam::Saturation: saturation = value; break;
+                case FixtureParam::Pan: pan = value * 255.0f; hasDirection = true; break;
+                case FixtureParam::Tilt: tilt = value * 255.0f; hasDirection = true; break;
+                }
+            }
+
+            setLightColor(Color(CM_HSV, hue, saturation, brightness));
+            if (hasDirection) {
+                setLightDirection(pan, tilt);
+            }
+            co_await cue::wait(stepMs);
+        }
+    }
+}
+
 CINDER_APP(CinderProjectApp, RendererGl)
@@ -0,0 +1,418 @@
+#include "CsvDataset.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <thread>
+
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+using namespace std;
+using namespace boost::interprocess;
+
+namespace {
+
+// Slices smaller than this are not worth a thread of their own
+const size_t kMinSliceSize = 1024 * 1024;
+// Rows sampled after the header to decide which columns hold text
+const size_t kTypeSampleRows = 100;
+
+void trim( const char*& begin, const char*& end )
+{
+	while ( begin < end && ( *begin == ' ' || *begin == '\t' ) ) {
+		++begin;
+	}
+	while ( end > begin && ( end[ -1 ] == ' ' || end[ -1 ] == '\t' || end[ -1 ] == '\r' ) ) {
+		--end;
+	}
+	if ( end - begin >= 2 && *begin == '"' && end[ -1 ] == '"' ) {
+		++begin;
+		--end;
+	}
+}
+
+bool parseFloat( const char* begin, const char* end, float& value )
+{
+	trim( begin, end );
+	if ( begin == end ) {
+		return false;
+	}
+	if ( *begin == '+' ) {
+		++begin;
+	}
+	from_chars_result result = from_chars( begin, end, value );
+	return result.ec == errc() && result.ptr == end;
+}
+
+// Calls fn( index, begin, end ) for every field of the line [begin, end)
+template<typename Fn>
+void splitLine( const char* begin, const char* end, char delimiter, Fn fn )
+{
+	size_t index		= 0;
+	const char* field	= begin;
+	bool quoted			= false;
+	for ( const char* p = begin; p < end; ++p ) {
+		if ( *p == '"' ) {
+			quoted = !quoted;
+		} else if ( *p == delimiter && !quoted ) {
+			fn( index++, field, p );
+			field = p + 1;
+		}
+	}
+	fn( index, field, end );
+}
+
+const char* findLineEnd( const char* begin, const char* end )
+{
+	const char* p = static_cast<const char*>( memchr( begin, '\n', end - begin ) );
+	return p != nullptr ? p : end;
+}
+
+}
+
+size_t CsvChunk::getFirstRow() const
+{
+	return mFirstRow;
+}
+
+size_t CsvChunk::getNumRows() const
+{
+	return mNumRows;
+}
+
+const vector<float>& CsvChunk::getValues( size_t column ) const
+{
+	return mValues[ column ];
+}
+
+const vector<string>& CsvChunk::getText( size_t column ) const
+{
+	return mText[ column ];
+}
+
+pair<float, float> CsvChunk::getRange( size_t column ) const
+{
+	float lo = numeric_limits<float>::max();
+	float hi = numeric_limits<float>::lowest();
+	for ( float value : mValues[ column ] ) {
+		if ( !isnan( value ) ) {
+			lo = min( lo, value );
+			hi = max( hi, value );
+		}
+	}
+	return lo <= hi ? make_pair( lo, hi ) : make_pair( 0.0f, 0.0f );
+}
+
+void CsvChunk::clear()
+{
+	mFirstRow	= 0;
+	mNumRows	= 0;
+	for ( vector<float>& values : mValues ) {
+		values.clear();
+	}
+	for ( vector<string>& text : mText ) {
+		text.clear();
+	}
+}
+
+CsvStream::CsvStream( char delimiter, size_t windowSize, size_t numThreads )
+	: mDelimiter( delimiter ), mWindowSize( max<size_t>( windowSize, 4096 ) ), mNumThreads( numThreads )
+{
+	if ( mNumThreads == 0 ) {
+		mNumThreads = max( 1u, thread::hardware_concurrency() );
+	}
+}
+
+bool CsvStream::open( const string& path )
+{
+	mPath		= path;
+	mFileSize	= 0;
+	mOffset		= 0;
+	mRow		= 0;
+	mColumnNames.clear();
+	mTextColumns.clear();
+	mSelected.clear();
+
+	try {
+		mFileSize = filesystem::file_size( path );
+		if ( mFileSize == 0 ) {
+			fail( "CSV file is empty: " + path );
+			return false;
+		}
+
+		file_mapping file( path.c_str(), read_only );
+		size_t length = static_cast<size_t>( min<uint64_t>( mWindowSize, mFileSize ) );
+		mapped_region region( file, read_only, 0, length );
+
+		const char* data	= static_cast<const char*>( region.get_address() );
+		const char* end		= data + length;
+		if ( length >= 3 && memcmp( data, "\xEF\xBB\xBF", 3 ) == 0 ) {
+			data += 3;
+		}
+
+		const char* headerEnd = findLineEnd( data, end );
+		if ( headerEnd == end && length < mFileSize ) {
+			fail( "CSV header does not fit in the mapping window." );
+			return false;
+		}
+		splitLine( data, headerEnd, mDelimiter, [&]( size_t, const char* b, const char* e ) {
+			trim( b, e );
+			mColumnNames.emplace_back( b, e );
+		} );
+		mTextColumns.assign( mColumnNames.size(), false );
+
+		// A column holds text if most of its non-empty sampled fields are not
+		// numbers. Stray cells such as "NA" in a numeric column become NaN.
+		vector<size_t> numNumeric( mColumnNames.size(), 0 );
+		vector<size_t> numText( mColumnNames.size(), 0 );
+		const char* rowBegin = min( headerEnd + 1, end );
+		for ( size_t row = 0; row < kTypeSampleRows && rowBegin < end; ++row ) {
+			const char* rowEnd = findLineEnd( rowBegin, end );
+			if ( rowEnd == end && length < mFileSize ) {
+				// Cut off by the window
+				break;
+			}
+			splitLine( rowBegin, rowEnd, mDelimiter, [&]( size_t index, const char* b, const char* e ) {
+				float value = 0.0f;
+				trim( b, e );
+				if ( index < mColumnNames.size() && b != e ) {
+					++( parseFloat( b, e, value ) ? numNumeric : numText )[ index ];
+				}
+			} );
+			rowBegin = rowEnd + 1;
+		}
+		for ( size_t c = 0; c < mColumnNames.size(); ++c ) {
+			mTextColumns[ c ] = numText[ c ] > numNumeric[ c ];
+		}
+		mSelected.assign( mColumnNames.size(), true );
+
+		mOffset = static_cast<uint64_t>( min( headerEnd + 1, end ) - static_cast<const char*>( region.get_address() ) );
+	} catch ( const std::exception& ex ) {
+		fail( ex.what() );
+		mColumnNames.clear();
+		return false;
+	}
+	return true;
+}
+
+bool CsvStream::next( CsvChunk& chunk )
+{
+	chunk.clear();
+	chunk.mValues.resize( mColumnNames.size() );
+	chunk.mText.resize( mColumnNames.size() );
+	if ( !isOpen() || mOffset >= mFileSize ) {
+		return false;
+	}
+
+	try {
+		file_mapping file( mPath.c_str(), read_only );
+		uint64_t pageSize	= mapped_region::get_page_size();
+		size_t window		= mWindowSize;
+
+		for ( ;; ) {
+			uint64_t aligned	= mOffset - mOffset % pageSize;
+			size_t skip			= static_cast<size_t>( mOffset - aligned );
+			size_t length		= static_cast<size_t>( min<uint64_t>( skip + window, mFileSize - aligned ) );
+			bool isLast			= aligned + length >= mFileSize;
+			mapped_region region( file, read_only, aligned, length );
+
+			const char* data	= static_cast<const char*>( region.get_address() ) + skip;
+			const char* end		= static_cast<const char*>( region.get_address() ) + length;
+
+			// Only whole lines are parsed; the remainder starts the next window
+			if ( !isLast ) {
+				const char* last = end;
+				while ( last > data && last[ -1 ] != '\n' ) {
+					--last;
+				}
+				if ( last == data ) {
+					window *= 2;
+					continue;
+				}
+				end = last;
+			}
+
+			size_t size			= end - data;
+			size_t numSlices	= min( mNumThreads, max<size_t>( size / kMinSliceSize, 1 ) );
+
+			vector<CsvChunk> parts( numSlices );
+			vector<thread> threads;
+			threads.reserve( numSlices - 1 );
+
+			const char* sliceBegin = data;
+			for ( size_t i = 0; i < numSlices; ++i ) {
+				const char* sliceEnd = end;
+				if ( i + 1 < numSlices ) {
+					sliceEnd = findLineEnd( max( sliceBegin, data + size * ( i + 1 ) / numSlices ), end );
+					sliceEnd = min( sliceEnd + 1, end );
+				}
+				parts[ i ].mValues.resize( mColumnNames.size() );
+				parts[ i ].mText.resize( mColumnNames.size() );
+				if ( i + 1 < numSlices ) {
+					threads.emplace_back( [this, sliceBegin, sliceEnd, &parts, i]() {
+						parseSlice( sliceBegin, sliceEnd, parts[ i ] );
+					} );
+				} else {
+					parseSlice( sliceBegin, sliceEnd, parts[ i ] );
+				}
+				sliceBegin = sliceEnd;
+			}
+			for ( thread& t : threads ) {
+				t.join();
+			}
+
+			size_t numRows = 0;
+			for ( const CsvChunk& part : parts ) {
+				numRows += part.mNumRows;
+			}
+			// The first part is moved in and every other part is freed as soon
+			// as it has been appended, to keep the peak close to one window
+			for ( size_t c = 0; c < mColumnNames.size(); ++c ) {
+				if ( !mSelected[ c ] ) {
+					continue;
+				}
+				vector<float>& values	= chunk.mValues[ c ];
+				vector<string>& text	= chunk.mText[ c ];
+				values					= move( parts[ 0 ].mValues[ c ] );
+				text					= move( parts[ 0 ].mText[ c ] );
+				if ( mTextColumns[ c ] ) {
+					text.reserve( numRows );
+				} else {
+					values.reserve( numRows );
+				}
+				for ( size_t i = 1; i < parts.size(); ++i ) {
+					values.insert( values.end(), parts[ i ].mValues[ c ].begin(), parts[ i ].mValues[ c ].end() );
+					text.insert( text.end(), make_move_iterator( parts[ i ].mText[ c ].begin() ), make_move_iterator( parts[ i ].mText[ c ].end() ) );
+					vector<float>().swap( parts[ i ].mValues[ c ] );
+					vector<string>().swap( parts[ i ].mText[ c ] );
+				}
+			}
+			chunk.mNumRows	= numRows;
+			chunk.mFirstRow	= mRow;
+			mRow			+= numRows;
+			mOffset			+= size;
+			break;
+		}
+	} catch ( const std::exception& ex ) {
+		fail( ex.what() );
+		mOffset = mFileSize;
+		return false;
+	}
+
+	return chunk.mNumRows > 0 || mOffset < mFileSize;
+}
+
+void CsvStream::selectColumns( const vector<int32_t>& columns )
+{
+	mSelected.assign( mColumnNames.size(), columns.empty() );
+	for ( int32_t column : columns ) {
+		if ( column >= 0 && static_cast<size_t>( column ) < mSelected.size() ) {
+			mSelected[ column ] = true;
+		}
+	}
+}
+
+bool CsvStream::isOpen() const
+{
+	return !mColumnNames.empty();
+}
+
+const vector<string>& CsvStream::getColumnNames() const
+{
+	return mColumnNames;
+}
+
+bool CsvStream::isTextColumn( size_t column ) const
+{
+	return mTextColumns[ column ];
+}
+
+int32_t CsvStream::findColumn( const string& name ) const
+{
+	vector<string>::const_iterator iter = find( mColumnNames.begin(), mColumnNames.end(), name );
+	return iter != mColumnNames.end() ? static_cast<int32_t>( iter - mColumnNames.begin() ) : -1;
+}
+
+uint64_t CsvStream::getFileSize() const
+{
+	return mFileSize;
+}
+
+uint64_t CsvStream::getOffset() const
+{
+	return mOffset;
+}
+
+void CsvStream::connectFailEventHandler( const FailEventHandler& eventHandler )
+{
+	mFailEventHandler = eventHandler;
+}
+
+void CsvStream::parseSlice( const char* begin, const char* end, CsvChunk& chunk ) const
+{
+	size_t numColumns = mColumnNames.size();
+	while ( begin < end ) {
+		const char* lineEnd = findLineEnd( begin, end );
+		const char* b		= begin;
+		const char* e		= lineEnd;
+		trim( b, e );
+		if ( b != e ) {
+			size_t numFields = 0;
+			splitLine( begin, lineEnd, mDelimiter, [&]( size_t index, const char* fb, const char* fe ) {
+				if ( index >= numColumns ) {
+					return;
+				}
+				numFields = index + 1;
+				if ( !mSelected[ index ] ) {
+					return;
+				}
+				if ( mTextColumns[ index ] ) {
+					trim( fb, fe );
+					chunk.mText[ index ].emplace_back( fb, fe );
+				} else {
+					float value = 0.0f;
+					chunk.mValues[ index ].push_back( parseFloat( fb, fe, value ) ? value : numeric_limits<float>::quiet_NaN() );
+				}
+			} );
+
+			// Short rows are padded so every column keeps the same length
+			for ( size_t c = numFields; c < numColumns; ++c ) {
+				if ( !mSelected[ c ] ) {
+					continue;
+				}
+				if ( mTextColumns[ c ] ) {
+					chunk.mText[ c ].emplace_back();
+				} else {
+					chunk.mValues[ c ].push_back( numeric_limits<float>::quiet_NaN() );
+				}
+			}
+			++chunk.mNumRows;
+		}
+		begin = lineEnd + 1;
+	}
+}
+
+void CsvStream::fail( const string& msg ) const
+{
+	if ( mFailEventHandler != nullptr ) {
+		mFailEventHandler( msg );
+	}
+}
+
+float CsvBinding::normalize( float value, const pair<float, float>& range ) const
+{
+	float lo = mMin;
+	float hi = mMax;
+	if ( lo == hi ) {
+		lo = range.first;
+		hi = range.second;
+	}
+	if ( isnan( value ) || hi <= lo ) {
+		return 0.0f;
+	}
+	return min( max( ( value - lo ) / ( hi - lo ), 0.0f ), 1.0f );
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Streaming reader for columnar CSV datasets such as data.csv. The file is
+// memory-mapped one window at a time and each window is parsed in parallel
+// into per-column arrays, so files larger than memory can be swept through
+// row by row. Fields are split on the delimiter and rows on '\n'; quoted
+// fields may contain the delimiter but not line breaks.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! One window of parsed rows, stored column by column.
+class CsvChunk
+{
+public:
+	size_t								getFirstRow() const;
+	size_t								getNumRows() const;
+
+	//! Values of a numeric column. Missing or malformed fields are NaN, and
+	//! columns not selected with CsvStream::selectColumns() are empty.
+	const std::vector<float>&			getValues( size_t column ) const;
+	//! Values of a text column. Empty for numeric columns.
+	const std::vector<std::string>&		getText( size_t column ) const;
+	//! Minimum and maximum of a numeric column within this chunk.
+	std::pair<float, float>				getRange( size_t column ) const;
+
+	void								clear();
+protected:
+	size_t								mFirstRow	= 0;
+	size_t								mNumRows	= 0;
+	std::vector<std::vector<float>>		mValues;
+	std::vector<std::vector<std::string>>	mText;
+
+	friend class CsvStream;
+};
+
+class CsvStream
+{
+public:
+	typedef std::function<void( const std::string& )> FailEventHandler;
+
+	explicit CsvStream( char delimiter = ',', size_t windowSize = 64 * 1024 * 1024, size_t numThreads = 0 );
+
+	//! Reads the header and samples the first rows to determine the column layout.
+	bool								open( const std::string& path );
+	//! Restricts parsing to \a columns; the others stay empty in every chunk.
+	//! An empty list selects all columns. Call after open().
+	void								selectColumns( const std::vector<int32_t>& columns );
+	//! Parses the next window into \a chunk. Returns false at end of file.
+	//! While merging, the per-thread results and \a chunk coexist, so peak
+	//! memory is about twice one window's parsed selected columns.
+	bool								next( CsvChunk& chunk );
+
+	bool								isOpen() const;
+	const std::vector<std::string>&		getColumnNames() const;
+	bool								isTextColumn( size_t column ) const;
+	//! Returns the index of the column named \a name, or -1.
+	int32_t								findColumn( const std::string& name ) const;
+	uint64_t							getFileSize() const;
+	uint64_t							getOffset() const;
+
+	void								connectFailEventHandler( const FailEventHandler& eventHandler );
+protected:
+	std::string							mPath;
+	char								mDelimiter;
+	size_t								mWindowSize;
+	size_t								mNumThreads;
+
+	uint64_t							mFileSize	= 0;
+	uint64_t							mOffset		= 0;
+	size_t								mRow		= 0;
+	std::vector<std::string>			mColumnNames;
+	std::vector<bool>					mTextColumns;
+	std::vector<bool>					mSelected;
+
+	FailEventHandler					mFailEventHandler;
+
+	void								parseSlice( const char* begin, const char* end, CsvChunk& chunk ) const;
+	void								fail( const std::string& msg ) const;
+};
+
+//! Fixture parameters a numeric column can drive.
+enum class FixtureParam : uint8_t
+{
+	Brightness,
+	Hue,
+	Saturation,
+	Pan,
+	Tilt
+};
+
+//! Maps a numeric column onto a fixture parameter in [0, 1] using the fixed
+//! range [mMin, mMax]. If mMin equals mMax the range of each chunk is used
+//! instead, which rescales at every window boundary of a large file.
+struct CsvBinding
+{
+	std::string		mColumn;
+	FixtureParam	mParam;
+	float			mMin	= 0.0f;
+	float			mMax	= 0.0f;
+	int32_t			mIndex	= -1;
+
+	float			normalize( float value, const std::pair<float, float>& range ) const;
+};
@@ -0,0 +1,188 @@
+#include "CueScript.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+Cue Cue::promise_type::get_return_object()
+{
+	return Cue( Handle::from_promise( *this ) );
+}
+
+Cue::Cue( Handle handle )
+	: mHandle( handle )
+{
+}
+
+Cue::Cue( Cue&& rhs ) noexcept
+	: mHandle( rhs.release() )
+{
+}
+
+Cue& Cue::operator=( Cue&& rhs ) noexcept
+{
+	if ( this != &rhs ) {
+		if ( mHandle ) {
+			mHandle.destroy();
+		}
+		mHandle = rhs.release();
+	}
+	return *this;
+}
+
+Cue::~Cue()
+{
+	if ( mHandle ) {
+		mHandle.destroy();
+	}
+}
+
+Cue::Handle Cue::release()
+{
+	Handle handle	= mHandle;
+	mHandle			= nullptr;
+	return handle;
+}
+
+CueScheduler::CueScheduler( size_t capacity )
+{
+	mCues.reserve( capacity );
+}
+
+CueScheduler::~CueScheduler()
+{
+	stopAll();
+}
+
+void CueScheduler::start( Cue&& cue )
+{
+	Cue::Handle handle = cue.release();
+	if ( !handle ) {
+		return;
+	}
+	handle.promise().mScheduler	= this;
+	handle.promise().mTime		= mTime;
+	handle.promise().mWakeAt	= mTime;
+	mCues.push_back( handle );
+}
+
+void CueScheduler::stopAll()
+{
+	for ( Cue::Handle& handle : mCues ) {
+		handle.destroy();
+	}
+	mCues.clear();
+}
+
+void CueScheduler::tick( double time )
+{
+	mTime = time;
+
+	int64_t beatIndex	= static_cast<int64_t>( floor( time * mBpm / 60.0 ) );
+	bool isBeat			= beatIndex != mBeatIndex;
+	mBeatIndex			= beatIndex;
+
+	// Cues started while resuming are appended and first run in this pass
+	for ( size_t i = 0; i < mCues.size(); ) {
+		Cue::Handle handle			= mCues[ i ];
+		Cue::promise_type& promise	= handle.promise();
+
+		bool resume = false;
+		if ( promise.mFade != nullptr ) {
+			double t = promise.mFadeDuration > 0.0 ? ( time - promise.mFadeStart ) / promise.mFadeDuration : 1.0;
+			t = min( max( t, 0.0 ), 1.0 );
+			promise.mFade->apply( static_cast<float>( t ) );
+			if ( t >= 1.0 ) {
+				promise.mFade	= nullptr;
+				promise.mTime	= promise.mFadeStart + promise.mFadeDuration;
+				resume			= true;
+			}
+		} else if ( promise.mWaitForBeat ) {
+			if ( isBeat ) {
+				promise.mWaitForBeat	= false;
+				promise.mTime			= static_cast<double>( beatIndex ) * 60.0 / mBpm;
+				resume					= true;
+			}
+		} else if ( time >= promise.mWakeAt ) {
+			promise.mTime		= promise.mSyncToTick ? time : promise.mWakeAt;
+			promise.mSyncToTick	= false;
+			resume				= true;
+		}
+
+		if ( resume ) {
+			handle.resume();
+		}
+
+		if ( handle.done() ) {
+			exception_ptr ex = handle.promise().mException;
+			handle.destroy();
+			mCues[ i ] = mCues.back();
+			mCues.pop_back();
+
+			if ( ex ) {
+				try {
+					rethrow_exception( ex );
+				} catch ( const std::exception& e ) {
+					if ( mFailEventHandler != nullptr ) {
+						mFailEventHandler( e.what() );
+					}
+				} catch ( ... ) {
+					if ( mFailEventHandler != nullptr ) {
+						mFailEventHandler( "An unknown exception occurred in a cue." );
+					}
+				}
+			}
+		} else {
+			++i;
+		}
+	}
+}
+
+void CueScheduler::setTempo( float bpm )
+{
+	mBpm		= max( bpm, 1.0f );
+	mBeatIndex	= static_cast<int64_t>( floor( mTime * mBpm / 60.0 ) );
+}
+
+float CueScheduler::getTempo() const
+{
+	return mBpm;
+}
+
+double CueScheduler::getTime() const
+{
+	return mTime;
+}
+
+size_t CueScheduler::getNumActive() const
+{
+	return mCues.size();
+}
+
+void CueScheduler::connectFailEventHandler( const FailEventHandler& eventHandler )
+{
+	mFailEventHandler = eventHandler;
+}
+
+namespace cue {
+
+void Wait::await_suspend( Cue::Handle handle ) const noexcept
+{
+	Cue::promise_type& promise	= handle.promise();
+	promise.mWakeAt				= promise.mTime + mSeconds;
+}
+
+void NextTick::await_suspend( Cue::Handle handle ) const noexcept
+{
+	Cue::promise_type& promise	= handle.promise();
+	promise.mWakeAt				= promise.mScheduler->getTime();
+	promise.mSyncToTick			= true;
+}
+
+void Beat::await_suspend( Cue::Handle handle ) const noexcept
+{
+	handle.promise().mWaitForBeat = true;
+}
+
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+// Server-side cue scripts written as C++20 coroutines. A script is a function
+// returning Cue that suspends on cue::wait(), cue::beat() or cue::fade(). All
+// cues are resumed by a single CueScheduler from the app's output tick, so a
+// running cue costs no thread, and suspending allocates nothing: the only
+// allocation is the coroutine frame created when the script is called.
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+class CueScheduler;
+
+//! Per-tick step of a running fade. The concrete step is the awaiter itself,
+//! which lives in the suspended coroutine frame until the fade completes.
+class CueFadeStep
+{
+public:
+	virtual void	apply( float value ) = 0;
+protected:
+	~CueFadeStep() = default;
+};
+
+class Cue
+{
+public:
+	struct promise_type
+	{
+		CueScheduler*		mScheduler		= nullptr;
+		//! Time the current step was due. Steps are timed from here rather
+		//! than from the tick that resumed the cue, so frame jitter does not
+		//! accumulate across steps.
+		double				mTime			= 0.0;
+		double				mWakeAt			= 0.0;
+		bool				mSyncToTick		= false;
+		bool				mWaitForBeat	= false;
+		CueFadeStep*		mFade			= nullptr;
+		double				mFadeStart		= 0.0;
+		double				mFadeDuration	= 0.0;
+		std::exception_ptr	mException;
+
+		Cue						get_return_object();
+		std::suspend_always		initial_suspend() noexcept { return {}; }
+		std::suspend_always		final_suspend() noexcept { return {}; }
+		void					return_void() {}
+		void					unhandled_exception() { mException = std::current_exception(); }
+	};
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	Cue() = default;
+	Cue( Cue&& rhs ) noexcept;
+	Cue& operator=( Cue&& rhs ) noexcept;
+	~Cue();
+
+	Cue( const Cue& ) = delete;
+	Cue& operator=( const Cue& ) = delete;
+
+	//! Transfers ownership of the coroutine frame to the caller.
+	Handle			release();
+protected:
+	explicit Cue( Handle handle );
+
+	Handle			mHandle;
+};
+
+class CueScheduler
+{
+public:
+	typedef std::function<void( const std::string& )> FailEventHandler;
+
+	explicit CueScheduler( size_t capacity = 1024 );
+	~CueScheduler();
+
+	//! Takes ownership of \a cue. It first runs in the next call to tick(), or
+	//! later in the current pass when started by a cue during tick().
+	void			start( Cue&& cue );
+	void			stopAll();
+
+	//! Resumes every cue whose wait, beat or fade is due. \a time is in seconds.
+	void			tick( double time );
+
+	void			setTempo( float bpm );
+	float			getTempo() const;
+	double			getTime() const;
+	size_t			getNumActive() const;
+
+	void			connectFailEventHandler( const FailEventHandler& eventHandler );
+protected:
+	std::vector<Cue::Handle>	mCues;
+	double						mTime		= 0.0;
+	float						mBpm		= 120.0f;
+	int64_t						mBeatIndex	= 0;
+
+	FailEventHandler			mFailEventHandler;
+};
+
+namespace cue {
+
+//! Suspends the cue for \a ms milliseconds.
+class Wait
+{
+public:
+	explicit Wait( double ms ) : mSeconds( ms / 1000.0 ) {}
+
+	bool			await_ready() const noexcept { return mSeconds <= 0.0; }
+	void			await_suspend( Cue::Handle handle ) const noexcept;
+	void			await_resume() const noexcept {}
+protected:
+	double			mSeconds;
+};
+
+//! Suspends the cue until the next call to tick(), e.g. to poll a future.
+class NextTick
+{
+public:
+	bool			await_ready() const noexcept { return false; }
+	void			await_suspend( Cue::Handle handle ) const noexcept;
+	void			await_resume() const noexcept {}
+};
+
+//! Suspends the cue until the next beat of the scheduler's tempo.
+class Beat
+{
+public:
+	bool			await_ready() const noexcept { return false; }
+	void			await_suspend( Cue::Handle handle ) const noexcept;
+	void			await_resume() const noexcept {}
+};
+
+//! Calls \a fn with a value interpolated from \a from to \a to on every tick
+//! for \a ms milliseconds, then resumes the cue.
+template<typename Fn>
+class Fade : public CueFadeStep
+{
+public:
+	Fade( float from, float to, double ms, Fn fn )
+		: mFrom( from ), mTo( to ), mSeconds( ms / 1000.0 ), mFn( std::move( fn ) ) {}
+
+	bool			await_ready() const noexcept { return mSeconds <= 0.0; }
+	void			await_suspend( Cue::Handle handle )
+	{
+		Cue::promise_type& promise	= handle.promise();
+		promise.mFade				= this;
+		promise.mFadeStart			= promise.mTime;
+		promise.mFadeDuration		= mSeconds;
+		mFn( mFrom );
+	}
+	void			await_resume()
+	{
+		if ( mSeconds <= 0.0 ) {
+			mFn( mTo );
+		}
+	}
+
+	void			apply( float t ) override
+	{
+		mFn( mFrom + ( mTo - mFrom ) * t );
+	}
+protected:
+	float			mFrom;
+	float			mTo;
+	double			mSeconds;
+	Fn				mFn;
+};
+
+inline Wait wait( double ms )
+{
+	return Wait( ms );
+}
+
+inline NextTick nextTick()
+{
+	return NextTick();
+}
+
+inline Beat beat()
+{
+	return Beat();
+}
+
+template<typename Fn>
+Fade<Fn> fade( float from, float to, double ms, Fn fn )
+{
+	return Fade<Fn>( from, to, ms, std::move( fn ) );
+}
+
+}
@@ -0,0 +1,147 @@
+#include "GestureColorMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ci;
+using namespace std;
+
+namespace {
+
+// Maps a direction to [0, 4) monotonically in its angle, without atan2: each
+// quadrant of the unit diamond |x| + |y| = 1 covers one unit.
+inline float diamondAngle( float x, float y )
+{
+	float t		= y / ( fabs( x ) + fabs( y ) + 1e-6f );
+	float left	= static_cast<float>( x < 0.0f );
+	float below	= static_cast<float>( y < 0.0f );
+	return ( 1.0f - left ) * ( t + 4.0f * below ) + left * ( 2.0f - t );
+}
+
+// Inverse of diamondAngle(), used when building the table
+float diamondToRadians( float p )
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	if ( p < 1.0f ) {
+		x = 1.0f - p;
+		y = p;
+	} else if ( p < 2.0f ) {
+		x = 1.0f - p;
+		y = 2.0f - p;
+	} else if ( p < 3.0f ) {
+		x = p - 3.0f;
+		y = 2.0f - p;
+	} else {
+		x = p - 3.0f;
+		y = p - 4.0f;
+	}
+	return atan2( y, x );
+}
+
+}
+
+GestureColorMap::GestureColorMap( const FixtureProfile& profile, float maxSpeed )
+	: mProfile( profile )
+{
+	setMaxSpeed( maxSpeed );
+	build();
+}
+
+void GestureColorMap::setProfile( const FixtureProfile& profile )
+{
+	mProfile = profile;
+	build();
+}
+
+const FixtureProfile& GestureColorMap::getProfile() const
+{
+	return mProfile;
+}
+
+void GestureColorMap::setMaxSpeed( float maxSpeed )
+{
+	mMaxSpeed	= max( maxSpeed, 1.0f );
+	mSpeedScale	= static_cast<float>( kSpeedSteps - 1 ) / mMaxSpeed;
+}
+
+void GestureColorMap::setSmoothing( float smoothing )
+{
+	mSmoothing = min( max( smoothing, 0.0f ), 0.99f );
+}
+
+float GestureColorMap::getSmoothing() const
+{
+	return mSmoothing;
+}
+
+Rgbw GestureColorMap::lookup( const vec2& velocity ) const
+{
+	static const float kAngleScale = static_cast<float>( kAngleSteps ) / 4.0f;
+
+	size_t angle	= static_cast<size_t>( diamondAngle( velocity.x, velocity.y ) * kAngleScale ) & ( kAngleSteps - 1 );
+	float speed		= min( length( velocity ) * mSpeedScale, static_cast<float>( kSpeedSteps - 1 ) );
+	size_t step		= static_cast<size_t>( speed + 0.5f );
+	return mTable[ step * kAngleSteps + angle ];
+}
+
+void GestureColorMap::lookup( const vec2* velocities, size_t count, Rgbw* out ) const
+{
+	for ( size_t i = 0; i < count; ++i ) {
+		out[ i ] = lookup( velocities[ i ] );
+	}
+}
+
+Rgbw GestureColorMap::update( const vec2& delta, float dt )
+{
+	mVelocity = smooth( mVelocity, delta / max( dt, 1e-3f ) );
+	return lookup( mVelocity );
+}
+
+vec2 GestureColorMap::smooth( const vec2& previous, const vec2& velocity ) const
+{
+	return previous * mSmoothing + velocity * ( 1.0f - mSmoothing );
+}
+
+void GestureColorMap::reset()
+{
+	mVelocity = vec2( 0.0f );
+}
+
+Color GestureColorMap::toColor( const Rgbw& rgbw ) const
+{
+	float scale = mProfile.mMaxLevel > 0 ? 1.0f / mProfile.mMaxLevel : 0.0f;
+	return Color(
+		min( ( rgbw.r + rgbw.w ) * scale, 1.0f ),
+		min( ( rgbw.g + rgbw.w ) * scale, 1.0f ),
+		min( ( rgbw.b + rgbw.w ) * scale, 1.0f ) );
+}
+
+void GestureColorMap::build()
+{
+	static const float kTwoPi = 6.28318531f;
+
+	for ( size_t step = 0; step < kSpeedSteps; ++step ) {
+		// Slow strokes are pale and dim, fast strokes saturated and bright
+		float speed			= static_cast<float>( step ) / static_cast<float>( kSpeedSteps - 1 );
+		float saturation	= 0.2f + 0.8f * speed;
+		float intensity		= 0.3f + 0.7f * speed;
+
+		for ( size_t angle = 0; angle < kAngleSteps; ++angle ) {
+			float p			= ( static_cast<float>( angle ) + 0.5f ) * 4.0f / static_cast<float>( kAngleSteps );
+			float radians	= diamondToRadians( p );
+			float hue		= fmod( radians / kTwoPi + 1.0f, 1.0f );
+
+			// Split the colour into RGB plus the white they have in common
+			Color rgb	= Color( CM_HSV, hue, saturation, intensity );
+			float white	= min( rgb.r, min( rgb.g, rgb.b ) );
+			float level	= static_cast<float>( mProfile.mMaxLevel );
+
+			Rgbw& entry = mTable[ step * kAngleSteps + angle ];
+			entry.r = static_cast<uint8_t>( ( rgb.r - white ) * level + 0.5f );
+			entry.g = static_cast<uint8_t>( ( rgb.g - white ) * level + 0.5f );
+			entry.b = static_cast<uint8_t>( ( rgb.b - white ) * level + 0.5f );
+			entry.w = static_cast<uint8_t>( white * level + 0.5f );
+		}
+	}
+}
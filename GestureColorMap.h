@@ -0,0 +1,71 @@
+#pragma once
+
+// Continuous mapping from drag direction and speed to a fixture colour.
+// Direction selects the hue and speed selects saturation and intensity. The
+// result is precomputed into a quantized table of RGBW levels for the active
+// fixture profile, so a lookup needs no atan2 and no branches.
+
+#include <array>
+#include <cstdint>
+
+#include "cinder/Color.h"
+#include "cinder/Vector.h"
+
+//! DMX channel offsets and output ceiling of a colour fixture.
+struct FixtureProfile
+{
+	int			mRed		= 7;
+	int			mGreen		= 8;
+	int			mBlue		= 9;
+	int			mWhite		= 10;
+	uint8_t		mMaxLevel	= 255;
+};
+
+struct Rgbw
+{
+	uint8_t		r;
+	uint8_t		g;
+	uint8_t		b;
+	uint8_t		w;
+};
+
+class GestureColorMap
+{
+public:
+	static const size_t	kAngleSteps	= 256;
+	static const size_t	kSpeedSteps	= 32;
+
+	//! \a maxSpeed is the drag speed in pixels per second that maps to full
+	//! saturation and intensity.
+	explicit GestureColorMap( const FixtureProfile& profile = FixtureProfile(), float maxSpeed = 2000.0f );
+
+	void					setProfile( const FixtureProfile& profile );
+	const FixtureProfile&	getProfile() const;
+	void					setMaxSpeed( float maxSpeed );
+	//! Exponential smoothing of the drag velocity; 0 disables it.
+	void					setSmoothing( float smoothing );
+	float					getSmoothing() const;
+
+	//! Looks up the colour of a velocity in pixels per second, with y up.
+	Rgbw					lookup( const ci::vec2& velocity ) const;
+	//! Evaluates \a count velocities at once, e.g. one per active touch.
+	void					lookup( const ci::vec2* velocities, size_t count, Rgbw* out ) const;
+	//! Smoothed lookup for a single pointer that moved by \a delta in \a dt seconds.
+	Rgbw					update( const ci::vec2& delta, float dt );
+	//! Applies the smoothing to a velocity tracked by the caller, e.g. per touch.
+	ci::vec2				smooth( const ci::vec2& previous, const ci::vec2& velocity ) const;
+	void					reset();
+
+	//! Approximate on-screen colour of \a rgbw for the current profile.
+	ci::Color				toColor( const Rgbw& rgbw ) const;
+protected:
+	FixtureProfile			mProfile;
+	float					mMaxSpeed;
+	float					mSpeedScale;
+	float					mSmoothing	= 0.0f;
+	ci::vec2				mVelocity	= ci::vec2( 0.0f );
+
+	std::array<Rgbw, kAngleSteps * kSpeedSteps>	mTable;
+
+	void					build();
+};
@@ -0,0 +1,96 @@
+#include "PriorityLane.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PriorityLane::Command PriorityLane::classify( const string& msg )
+{
+	if ( msg.find( "\"type\":\"blackout\"" ) != string::npos ) {
+		return Command::Blackout;
+	} else if ( msg.find( "\"type\":\"emergency\"" ) != string::npos ) {
+		return Command::Emergency;
+	} else if ( msg.find( "\"type\":\"release\"" ) != string::npos ) {
+		return Command::Release;
+	}
+	return Command::None;
+}
+
+void PriorityLane::trigger( Command cmd )
+{
+	if ( cmd == Command::Release ) {
+		release();
+		return;
+	}
+	if ( cmd == Command::None ) {
+		return;
+	}
+
+	// A newer safety command replaces one that has not been applied yet;
+	// the latency is measured for the first pending trigger.
+	if ( mPending == Command::None ) {
+		mTriggeredAt = mDrainedAt;
+	}
+	mPending	= cmd;
+	mActive		= cmd;
+}
+
+void PriorityLane::release()
+{
+	// A command latched but not yet applied is kept, so a blackout and a
+	// release handled in the same drain still reach the fixture and the stats
+	mActive = Command::None;
+}
+
+PriorityLane::Command PriorityLane::take()
+{
+	if ( mPending == Command::None ) {
+		return Command::None;
+	}
+
+	Command cmd = mPending;
+	mPending	= Command::None;
+
+	mLastLatencyMs	= chrono::duration<double, milli>( Clock::now() - mTriggeredAt ).count();
+	mWorstLatencyMs	= max( mWorstLatencyMs, mLastLatencyMs );
+	++mCount;
+
+	return cmd;
+}
+
+void PriorityLane::markDrained()
+{
+	mDrainedAt = Clock::now();
+}
+
+bool PriorityLane::isLocked() const
+{
+	return mActive != Command::None;
+}
+
+PriorityLane::Command PriorityLane::getActive() const
+{
+	return mActive;
+}
+
+uint32_t PriorityLane::getCount() const
+{
+	return mCount;
+}
+
+double PriorityLane::getLastLatencyMs() const
+{
+	return mLastLatencyMs;
+}
+
+double PriorityLane::getWorstLatencyMs() const
+{
+	return mWorstLatencyMs;
+}
+
+void PriorityLane::resetStats()
+{
+	mCount			= 0;
+	mLastLatencyMs	= 0.0;
+	mWorstLatencyMs	= 0.0;
+}
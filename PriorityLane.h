@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Dedicated lane for safety commands (blackout, emergency). A command is
+// latched the moment its message is received, skipping the coalesced bulk
+// traffic, and is applied as soon as the caller next checks take(). While the
+// lane is locked, lower-priority sources must be ignored until release().
+//
+// Latency is measured from the end of the previous drain of the network
+// queue, since the message can have arrived any time after it. It therefore
+// includes the wait for the tick and the time spent behind queued traffic.
+class PriorityLane
+{
+public:
+	typedef std::chrono::steady_clock	Clock;
+
+	enum class Command : uint8_t
+	{
+		None,
+		Blackout,
+		Emergency,
+		Release
+	};
+
+	//! Classifies a raw WebSocket payload without fully parsing it.
+	static Command	classify( const std::string& msg );
+
+	void			trigger( Command cmd );
+	//! Unlocks the lane. A pending command is still returned by take().
+	void			release();
+
+	//! Returns the command to apply now, or Command::None, and records its
+	//! latency. Cheap enough to call after every handled message.
+	Command			take();
+	//! Marks the network queue as drained; later commands are timed from here.
+	void			markDrained();
+
+	bool			isLocked() const;
+	Command			getActive() const;
+
+	uint32_t		getCount() const;
+	double			getLastLatencyMs() const;
+	double			getWorstLatencyMs() const;
+	void			resetStats();
+protected:
+	Command				mActive			= Command::None;
+	Command				mPending		= Command::None;
+	Clock::time_point	mTriggeredAt;
+	Clock::time_point	mDrainedAt		= Clock::now();
+
+	uint32_t			mCount			= 0;
+	double				mLastLatencyMs	= 0.0;
+	double				mWorstLatencyMs	= 0.0;
+};
@@ -124,6 +124,11 @@ void WebSocketServer::poll()
 	mServer.poll();
 }
 
+size_t WebSocketServer::pollOne()
+{
+	return mServer.poll_one();
+}
+
 void WebSocketServer::run()
 {
 	mServer.run();
@@ -54,6 +54,7 @@ public:
 	void			listen( uint16_t port = 80 );
 	void			ping( const std::string& msg = "" );
 	void			poll();
+	size_t			pollOne();
 	void			run();
 	void			write( const std::string& msg );
 	void			write( void const * msg, size_t len );